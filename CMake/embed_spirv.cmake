@@ -0,0 +1,40 @@
+# Turns a SPIR-V binary into a C++ header holding it as an array of 32-bit words.
+#   cmake -DINPUT=<file.spv> -DOUTPUT=<header.hpp> -DNAME=<identifier> -P embed_spirv.cmake
+file(READ "${INPUT}" SPIRV_HEX HEX)
+string(LENGTH "${SPIRV_HEX}" SPIRV_HEX_LENGTH)
+math(EXPR SPIRV_REMAINDER "${SPIRV_HEX_LENGTH} % 8")
+if (SPIRV_HEX_LENGTH EQUAL 0 OR NOT SPIRV_REMAINDER EQUAL 0)
+    message(FATAL_ERROR "${INPUT} is not a valid SPIR-V module")
+endif ()
+
+# SPIR-V is a little-endian word stream, so swap each group of four bytes into a word literal.
+string(REGEX MATCHALL "........" SPIRV_WORDS "${SPIRV_HEX}")
+list(LENGTH SPIRV_WORDS SPIRV_WORD_COUNT)
+set(SPIRV_BODY "")
+set(SPIRV_COLUMN 0)
+foreach (WORD ${SPIRV_WORDS})
+    string(SUBSTRING "${WORD}" 0 2 B0)
+    string(SUBSTRING "${WORD}" 2 2 B1)
+    string(SUBSTRING "${WORD}" 4 2 B2)
+    string(SUBSTRING "${WORD}" 6 2 B3)
+    string(APPEND SPIRV_BODY "0x${B3}${B2}${B1}${B0},")
+    math(EXPR SPIRV_COLUMN "${SPIRV_COLUMN} + 1")
+    if (SPIRV_COLUMN EQUAL 8)
+        string(APPEND SPIRV_BODY "\n    ")
+        set(SPIRV_COLUMN 0)
+    else ()
+        string(APPEND SPIRV_BODY " ")
+    endif ()
+endforeach ()
+string(STRIP "${SPIRV_BODY}" SPIRV_BODY)
+
+file(WRITE "${OUTPUT}" "// Generated from ${INPUT}, do not edit.
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+inline constexpr std::array<uint32_t, ${SPIRV_WORD_COUNT}> ${NAME}Spirv = {
+    ${SPIRV_BODY}
+};
+")
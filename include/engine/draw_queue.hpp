@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan_raii.hpp>
+
+/**
+ * 64-bit draw sort key. Most significant field first, so sorting the raw integer groups draws by pass, then by
+ * pipeline, then by material and finally orders them by depth:
+ *
+ *   63      56 55      44 43            24 23            0
+ *   [  pass  ] [pipeline] [   material    ] [    depth    ]
+ */
+struct SortKey {
+    static constexpr uint32_t passBits = 8;
+    static constexpr uint32_t pipelineBits = 12;
+    static constexpr uint32_t materialBits = 20;
+    static constexpr uint32_t depthBits = 24;
+
+    static constexpr uint64_t make(const uint32_t pass, const uint32_t pipeline, const uint32_t material,
+                                   const uint32_t depth) {
+        return (static_cast<uint64_t>(pass & mask(passBits)) << (pipelineBits + materialBits + depthBits)) |
+               (static_cast<uint64_t>(pipeline & mask(pipelineBits)) << (materialBits + depthBits)) |
+               (static_cast<uint64_t>(material & mask(materialBits)) << depthBits) |
+               static_cast<uint64_t>(depth & mask(depthBits));
+    }
+
+    /**
+     * Quantizes a normalized depth in [0, 1] into the depth field. Pass invert = true for back-to-front passes
+     * such as transparency.
+     */
+    static constexpr uint32_t quantizeDepth(float depth, const bool invert = false) {
+        depth = depth < 0.0f ? 0.0f : depth > 1.0f ? 1.0f : depth;
+        const auto quantized = static_cast<uint32_t>(depth * static_cast<float>(mask(depthBits)));
+        return invert ? mask(depthBits) - quantized : quantized;
+    }
+
+private:
+    static constexpr uint32_t mask(const uint32_t bits) {
+        return (1u << bits) - 1u;
+    }
+};
+
+/**
+ * Everything needed to replay one draw. The pipeline is required, and so is the pipeline layout when a material set
+ * is given. Other handles left as nullptr are simply not bound.
+ */
+struct DrawPacket {
+    uint64_t sortKey;
+    vk::Pipeline pipeline;
+    vk::PipelineLayout pipelineLayout = nullptr;
+    vk::DescriptorSet materialSet = nullptr;
+    vk::Buffer vertexBuffer = nullptr;
+    vk::DeviceSize vertexBufferOffset = 0;
+    vk::Buffer indexBuffer = nullptr;
+    vk::DeviceSize indexBufferOffset = 0;
+    vk::IndexType indexType = vk::IndexType::eUint32;
+    uint32_t count = 0; // vertex count, or index count when an index buffer is set
+    uint32_t instanceCount = 1;
+    uint32_t first = 0; // first vertex, or first index when an index buffer is set
+    int32_t vertexOffset = 0; // added to every index, only used with an index buffer
+    uint32_t firstInstance = 0;
+};
+
+/**
+ * Per-frame draw submission queue. Systems push packets in any order; the queue radix sorts them by key and replays
+ * them into a command buffer, skipping binds of state that is already bound.
+ */
+class DrawQueue {
+public: // Properties
+    struct Statistics {
+        uint32_t packets = 0;
+        uint32_t pipelineBinds = 0;
+        uint32_t pipelineBindsSaved = 0;
+        uint32_t materialBinds = 0;
+        uint32_t materialBindsSaved = 0;
+        uint32_t vertexBufferBinds = 0;
+        uint32_t vertexBufferBindsSaved = 0;
+        uint32_t indexBufferBinds = 0;
+        uint32_t indexBufferBindsSaved = 0;
+    };
+
+private: // Member Variables
+    struct Entry {
+        uint64_t key;
+        uint32_t packet;
+    };
+
+    std::vector<DrawPacket> packets;
+    std::vector<Entry> entries;
+    std::vector<Entry> scratch;
+    bool sorted = true;
+    Statistics statistics;
+
+public: // Public Functions
+    DrawQueue() = default;
+    ~DrawQueue() = default;
+
+    DrawQueue(const DrawQueue &) = delete;
+    DrawQueue(DrawQueue &&) = delete;
+    DrawQueue &operator=(const DrawQueue &) = delete;
+
+    void reserve(size_t packetCount);
+    void push(const DrawPacket &packet);
+    // Drops all packets but keeps the allocations for the next frame.
+    void clear();
+
+    void sort();
+    // Sorts if needed, then records every packet. Viewport, scissor and rendering scope are the caller's business.
+    void submit(const vk::raii::CommandBuffer &commandBuffer);
+
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] const DrawPacket &at(size_t sortedIndex) const;
+    [[nodiscard]] const Statistics &getStatistics() const;
+};
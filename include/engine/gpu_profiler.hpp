@@ -0,0 +1,85 @@
+#pragma once
+
+#include <vector>
+
+#include <vulkan/vulkan_raii.hpp>
+
+#include "trace.hpp"
+
+/**
+ * WW_TRACE_GPU_ZONE(profiler, commandBuffer, "name") brackets the enclosing scope of recorded commands with
+ * timestamp queries. Compiles to nothing in WW_RELEASE.
+ */
+#ifdef WW_RELEASE
+#define WW_TRACE_GPU_ZONE(profiler, commandBuffer, name)
+#else
+#define WW_TRACE_GPU_ZONE(profiler, commandBuffer, name) \
+    const GpuTraceZone WW_TRACE_CONCAT(gpuTraceZone, __LINE__){profiler, commandBuffer, name}
+#endif
+
+/**
+ * Timestamp query based GPU zones that end up next to the CPU zones in the trace.
+ *
+ * One frame is in flight at a time: beginFrame() resets the pool at the start of the command buffer, markSubmit()
+ * is called right before the submit, and collect() after the frame's fence has been waited on. GPU ticks are mapped
+ * onto the CPU timeline by anchoring the frame's first timestamp at the submit time. That is an approximation (the
+ * GPU starts a little after the submit); VK_EXT_calibrated_timestamps would be needed for an exact mapping.
+ */
+class GpuProfiler {
+public: // Properties
+
+private: // Member Variables
+    struct Zone {
+        const char *name;
+        uint32_t beginQuery;
+        uint32_t endQuery;
+    };
+
+    vk::raii::QueryPool queryPool = nullptr;
+    double nanosecondsPerTick = 1.0;
+    uint64_t timestampMask = ~0ull;
+    uint32_t queryCapacity = 0;
+    uint32_t nextQuery = 0;
+    std::vector<Zone> zones;
+    uint32_t frame = 0;
+    uint64_t submitTime = 0;
+    bool pending = false;
+
+public: // Public Functions
+    GpuProfiler() = default;
+    ~GpuProfiler() = default;
+
+    GpuProfiler(const GpuProfiler &) = delete;
+    GpuProfiler(GpuProfiler &&) = delete;
+    GpuProfiler &operator=(const GpuProfiler &) = delete;
+
+    // Leaves the profiler disabled if the queue family does not support timestamps.
+    void init(const vk::raii::Device &device, const vk::raii::PhysicalDevice &physicalDevice, uint32_t queueFamilyIndex,
+              uint32_t maxZonesPerFrame = 64);
+
+    void beginFrame(const vk::raii::CommandBuffer &commandBuffer);
+    void markSubmit();
+    void collect();
+
+    // Returns the zone index to pass to endZone(), or ~0u if the zone could not be recorded.
+    uint32_t beginZone(const vk::raii::CommandBuffer &commandBuffer, const char *name);
+    void endZone(const vk::raii::CommandBuffer &commandBuffer, uint32_t zone);
+
+    [[nodiscard]] bool isEnabled() const;
+};
+
+class GpuTraceZone {
+private: // Member Variables
+    GpuProfiler &profiler;
+    const vk::raii::CommandBuffer &commandBuffer;
+    uint32_t zone;
+
+public: // Public Functions
+    GpuTraceZone(GpuProfiler &profiler, const vk::raii::CommandBuffer &commandBuffer, const char *name)
+        : profiler(profiler), commandBuffer(commandBuffer), zone(profiler.beginZone(commandBuffer, name)) {}
+    ~GpuTraceZone() { profiler.endZone(commandBuffer, zone); }
+
+    GpuTraceZone(const GpuTraceZone &) = delete;
+    GpuTraceZone(GpuTraceZone &&) = delete;
+    GpuTraceZone &operator=(const GpuTraceZone &) = delete;
+};
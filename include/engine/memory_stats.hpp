@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <functional>
+#include <vector>
+
+#include <vulkan/vulkan_raii.hpp>
+
+enum class MemoryCategory {
+    Buffer,
+    Image,
+    Staging,
+    Swapchain,
+    Count,
+};
+
+/**
+ * Engine-wide GPU memory statistics.
+ *
+ * Allocations are reported by whoever makes them, per category and heap. Once per frame update() refreshes the
+ * per-heap budget and usage, from VK_EXT_memory_budget when the device supports it and otherwise from the heap size
+ * and our own tracked usage. When a heap crosses the warning threshold a warning is printed once and the eviction
+ * callbacks are asked to free memory on every update until usage drops below it again. Recording allocations never
+ * runs the callbacks.
+ */
+class MemoryStats {
+public: // Properties
+    struct HeapStats {
+        vk::DeviceSize size = 0;
+        vk::DeviceSize budget = 0;
+        // Usage of the whole process as reported by the driver, or our tracked usage without the extension.
+        vk::DeviceSize usage = 0;
+        vk::DeviceSize peakUsage = 0;
+        vk::DeviceSize trackedUsage = 0;
+        bool deviceLocal = false;
+        bool overThreshold = false;
+    };
+
+    struct CategoryStats {
+        vk::DeviceSize current = 0;
+        vk::DeviceSize peak = 0;
+        uint32_t allocations = 0;
+    };
+
+    // Called with the heap that is over its threshold and the number of bytes needed to get back under it.
+    using EvictionCallback = std::function<void(uint32_t heapIndex, vk::DeviceSize bytesToFree)>;
+
+private: // Member Variables
+    const vk::raii::PhysicalDevice *physicalDevice = nullptr;
+    vk::PhysicalDeviceMemoryProperties memoryProperties{};
+    bool budgetSupported = false;
+    float warningThreshold = 0.9f;
+
+    std::vector<HeapStats> heaps;
+    std::array<CategoryStats, static_cast<size_t>(MemoryCategory::Count)> categories{};
+    std::vector<EvictionCallback> evictionCallbacks;
+
+public: // Public Functions
+    MemoryStats() = default;
+    ~MemoryStats() = default;
+
+    MemoryStats(const MemoryStats &) = delete;
+    MemoryStats(MemoryStats &&) = delete;
+    MemoryStats &operator=(const MemoryStats &) = delete;
+
+    // budgetSupported must only be true if VK_EXT_memory_budget was enabled on the device.
+    void init(const vk::raii::PhysicalDevice &physicalDevice, bool budgetSupported);
+    void update();
+
+    void recordAllocation(MemoryCategory category, uint32_t memoryTypeIndex, vk::DeviceSize size);
+    void recordFree(MemoryCategory category, uint32_t memoryTypeIndex, vk::DeviceSize size);
+    // For memory we do not allocate ourselves, such as swapchain images, where only the heap is known.
+    void recordHeapAllocation(MemoryCategory category, uint32_t heapIndex, vk::DeviceSize size);
+    void recordHeapFree(MemoryCategory category, uint32_t heapIndex, vk::DeviceSize size);
+
+    void setWarningThreshold(float fraction);
+    void addEvictionCallback(EvictionCallback callback);
+
+    [[nodiscard]] bool isBudgetSupported() const;
+    [[nodiscard]] uint32_t getDeviceLocalHeap() const;
+    [[nodiscard]] const std::vector<HeapStats> &getHeapStats() const;
+    [[nodiscard]] const CategoryStats &getCategoryStats(MemoryCategory category) const;
+
+private: // Private Methods
+    void checkThreshold(uint32_t heapIndex);
+};
+
+const char *to_string(MemoryCategory category);
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan_raii.hpp>
+
+#include "memory_stats.hpp"
+
+/**
+ * How a pass touches an image. The render graph derives the image layout, pipeline stage and access mask from this,
+ * so passes never spell out barriers themselves.
+ */
+enum class ResourceUsage {
+    ColorAttachment,
+    DepthStencilAttachment,
+    SampledRead,
+    StorageRead,
+    StorageWrite,
+    TransferSrc,
+    TransferDst,
+    Present,
+};
+
+struct ImageDesc {
+    vk::Format format;
+    vk::Extent2D extent;
+    vk::ImageAspectFlags aspect = vk::ImageAspectFlagBits::eColor;
+};
+
+/**
+ * Frame graph of passes that declare which images they read and write.
+ *
+ * Passes are added in submission order and the graph is compiled once. Compiling culls passes whose output is never
+ * consumed, precomputes one batched barrier per pass boundary and places transient images with disjoint lifetimes in
+ * the same device memory. Imported images (e.g. the swapchain image) are rebound every frame before execute().
+ *
+ * Every frame's first use of aliased memory waits on its last use in the previous frame, so several frames can be in
+ * flight as long as they are all submitted to the same queue.
+ */
+class RenderGraph {
+public: // Properties
+    using ResourceHandle = uint32_t;
+
+    class PassContext {
+    public:
+        const vk::raii::CommandBuffer &commandBuffer;
+
+        [[nodiscard]] vk::Image getImage(ResourceHandle handle) const;
+        [[nodiscard]] vk::ImageView getView(ResourceHandle handle) const;
+        [[nodiscard]] const ImageDesc &getDesc(ResourceHandle handle) const;
+
+    private:
+        friend class RenderGraph;
+        PassContext(const RenderGraph &graph, const vk::raii::CommandBuffer &commandBuffer);
+        const RenderGraph &graph;
+    };
+
+    class PassBuilder {
+    public:
+        void read(ResourceHandle handle, ResourceUsage usage);
+        void write(ResourceHandle handle, ResourceUsage usage);
+        // Keeps the pass alive even if nothing reads its outputs (e.g. readbacks, queries).
+        void setSideEffect();
+
+    private:
+        friend class RenderGraph;
+        PassBuilder(RenderGraph &graph, uint32_t passIndex);
+        RenderGraph &graph;
+        uint32_t passIndex;
+    };
+
+    using SetupCallback = std::function<void(PassBuilder &)>;
+    using ExecuteCallback = std::function<void(const PassContext &)>;
+
+    struct Statistics {
+        uint32_t declaredPasses = 0;
+        uint32_t culledPasses = 0;
+        uint32_t imageBarriers = 0;
+        uint32_t memoryBarriers = 0;
+        uint32_t barrierBatches = 0;
+        uint32_t transientImages = 0;
+        uint32_t memoryBlocks = 0;
+        vk::DeviceSize transientBytesRequested = 0;
+        vk::DeviceSize transientBytesAllocated = 0;
+    };
+
+private: // Member Variables
+    struct Access {
+        ResourceHandle handle;
+        ResourceUsage usage;
+        bool write;
+    };
+
+    struct Pass {
+        std::string name;
+        ExecuteCallback execute;
+        std::vector<Access> accesses;
+        bool sideEffect = false;
+        bool culled = false;
+    };
+
+    struct Resource {
+        std::string name;
+        ImageDesc desc;
+        bool imported = false;
+        vk::ImageLayout initialLayout = vk::ImageLayout::eUndefined;
+        vk::PipelineStageFlags2 initialStages = vk::PipelineStageFlagBits2::eNone;
+        bool hasFinalUsage = false;
+        ResourceUsage finalUsage = ResourceUsage::Present;
+
+        vk::Image image = nullptr;
+        vk::ImageView view = nullptr;
+
+        // transient only
+        vk::raii::Image ownedImage = nullptr;
+        vk::raii::ImageView ownedView = nullptr;
+        vk::ImageUsageFlags usageFlags;
+        uint32_t firstPass = ~0u;
+        uint32_t lastPass = 0;
+    };
+
+    struct BarrierTemplate {
+        ResourceHandle handle;
+        vk::ImageMemoryBarrier2 barrier;
+    };
+
+    // All barriers that have to be recorded before a given pass (or after the last one) as a single batch.
+    struct BarrierBatch {
+        std::vector<BarrierTemplate> barriers;
+        // Orders accesses to aliased memory that the image barriers do not cover.
+        std::vector<vk::MemoryBarrier2> memoryBarriers;
+    };
+
+    struct MemoryBlock {
+        vk::raii::DeviceMemory memory = nullptr;
+        vk::DeviceSize size = 0;
+        uint32_t memoryTypeBits = ~0u;
+        uint32_t memoryTypeIndex = 0;
+        std::vector<ResourceHandle> occupants;
+    };
+
+    // Declared before the resources so bound images are destroyed ahead of the memory backing them.
+    std::vector<MemoryBlock> memoryBlocks;
+    std::vector<Pass> passes;
+    std::vector<Resource> resources;
+    std::vector<uint32_t> executionOrder;
+    std::vector<BarrierBatch> passBarriers;
+    BarrierBatch finalBarriers;
+    std::vector<vk::ImageMemoryBarrier2> scratchBarriers;
+    Statistics statistics;
+    MemoryStats *memoryStats = nullptr;
+    bool compiled = false;
+
+public: // Public Functions
+    RenderGraph() = default;
+    ~RenderGraph();
+
+    RenderGraph(const RenderGraph &) = delete;
+    RenderGraph(RenderGraph &&) = delete;
+    RenderGraph &operator=(const RenderGraph &) = delete;
+
+    // initialStages is the stage the first barrier has to wait on, e.g. the wait stage of the acquire semaphore.
+    ResourceHandle importImage(std::string name, const ImageDesc &desc, vk::ImageLayout initialLayout,
+                               ResourceUsage finalUsage,
+                               vk::PipelineStageFlags2 initialStages = vk::PipelineStageFlagBits2::eTopOfPipe);
+    ResourceHandle createImage(std::string name, const ImageDesc &desc);
+    void addPass(std::string name, const SetupCallback &setup, ExecuteCallback execute);
+
+    // Can only be called once. Transient image memory is reported to memoryStats, if given, which then has to outlive
+    // the graph.
+    void compile(const vk::raii::Device &device, const vk::raii::PhysicalDevice &physicalDevice,
+                 MemoryStats *memoryStats = nullptr);
+    void setImportedImage(ResourceHandle handle, vk::Image image, vk::ImageView view);
+    void execute(const vk::raii::CommandBuffer &commandBuffer);
+
+    [[nodiscard]] const Statistics &getStatistics() const;
+
+private: // Private Methods
+    void cullPasses();
+    void computeLifetimes();
+    void buildBarriers();
+    void allocateTransients(const vk::raii::Device &device, const vk::raii::PhysicalDevice &physicalDevice);
+    void recordBatch(const vk::raii::CommandBuffer &commandBuffer, const BarrierBatch &batch);
+};
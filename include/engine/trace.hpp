@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/**
+ * Lightweight CPU trace zones.
+ *
+ * WW_TRACE_ZONE("name") records the enclosing scope into a buffer owned by the calling thread without taking a lock.
+ * Each thread hands its zones of a frame over to the shared trace the first time it records in a later frame, marks
+ * the frame or exits, so a lock is taken once per thread and frame rather than per zone. WW_TRACE_FRAME_MARK() advances
+ * the global frame counter once per frame and WW_TRACE_THREAD_NAME("name") labels the calling thread. Zones can be
+ * merged with GPU zones (see GpuProfiler) and exported as Chrome/Perfetto trace JSON for a range of frames.
+ *
+ * Zone names must be string literals or otherwise outlive the trace. Everything compiles to nothing in WW_RELEASE.
+ */
+#ifdef WW_RELEASE
+#define WW_TRACE_ZONE(name)
+#define WW_TRACE_FRAME_MARK()
+#define WW_TRACE_THREAD_NAME(name)
+#else
+#define WW_TRACE_CONCAT_INNER(a, b) a##b
+#define WW_TRACE_CONCAT(a, b) WW_TRACE_CONCAT_INNER(a, b)
+#define WW_TRACE_ZONE(name) const TraceZone WW_TRACE_CONCAT(traceZone, __LINE__){name}
+#define WW_TRACE_FRAME_MARK() Trace::markFrame()
+#define WW_TRACE_THREAD_NAME(name) Trace::setThreadName(name)
+#endif
+
+namespace Trace {
+    // Nanoseconds on the steady clock since the trace epoch (first use).
+    uint64_t now();
+    uint32_t getFrame();
+    void markFrame();
+    void setThreadName(std::string name);
+
+    void recordCpuZone(const char *name, uint64_t startNs, uint64_t endNs);
+    // GPU zones arrive after the fact, so they carry the frame they were recorded in.
+    void recordGpuZone(const char *name, uint64_t startNs, uint64_t endNs, uint32_t frame);
+
+    // Writes every handed-over zone of frames [firstFrame, lastFrame] as Chrome trace JSON. Zones of other threads
+    // that have not recorded anything since lastFrame are not handed over yet. Returns false if the file could not
+    // be written.
+    bool exportChromeTrace(const std::string &path, uint32_t firstFrame, uint32_t lastFrame);
+
+    // Only this many most recent frames are kept in memory.
+    inline constexpr uint32_t retainedFrames = 300;
+}
+
+class TraceZone {
+private: // Member Variables
+    const char *name;
+    uint64_t start;
+
+public: // Public Functions
+    explicit TraceZone(const char *name) : name(name), start(Trace::now()) {}
+    ~TraceZone() { Trace::recordCpuZone(name, start, Trace::now()); }
+
+    TraceZone(const TraceZone &) = delete;
+    TraceZone(TraceZone &&) = delete;
+    TraceZone &operator=(const TraceZone &) = delete;
+};
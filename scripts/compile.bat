@@ -1 +0,0 @@
-C:/VulkanSDK/1.4.321.1/bin/slangc.exe assets/shaders/shader.slang -target spirv -profile spirv_1_4 -emit-spirv-directly -fvk-use-entrypoint-name -entry vertMain -entry fragMain -o assets/shaders/shader.spv
\ No newline at end of file
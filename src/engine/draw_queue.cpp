@@ -0,0 +1,146 @@
+#include <array>
+#include <cassert>
+#include <engine/draw_queue.hpp>
+
+void DrawQueue::reserve(const size_t packetCount) {
+    packets.reserve(packetCount);
+    entries.reserve(packetCount);
+    scratch.reserve(packetCount);
+}
+
+void DrawQueue::push(const DrawPacket &packet) {
+    assert(packet.pipeline && "draw packets need a pipeline");
+    assert((!packet.materialSet || packet.pipelineLayout) && "a material set needs the pipeline layout to bind to");
+    entries.push_back({packet.sortKey, static_cast<uint32_t>(packets.size())});
+    packets.push_back(packet);
+    sorted = false;
+}
+
+void DrawQueue::clear() {
+    packets.clear();
+    entries.clear();
+    sorted = true;
+}
+
+void DrawQueue::sort() {
+    if (sorted || entries.size() < 2) {
+        sorted = true;
+        return;
+    }
+
+    // LSD radix sort over the key, 11 bits per pass so each histogram stays in L1 and 64 bits take six passes.
+    // Counting every histogram up front costs a single read of the keys and lets us skip digits that are identical
+    // across the frame (e.g. the pass field when there is only one pass), which is the common case for upper fields.
+    constexpr uint32_t digitBits = 11;
+    constexpr uint32_t radix = 1u << digitBits;
+    constexpr uint32_t digitCount = (64 + digitBits - 1) / digitBits;
+    std::array<std::array<uint32_t, radix>, digitCount> histograms{};
+    for (const auto &entry: entries) {
+        for (uint32_t digit = 0; digit < digitCount; ++digit) {
+            ++histograms[digit][(entry.key >> (digit * digitBits)) & (radix - 1)];
+        }
+    }
+
+    scratch.resize(entries.size());
+    const auto count = static_cast<uint32_t>(entries.size());
+    for (uint32_t digit = 0; digit < digitCount; ++digit) {
+        const uint32_t shift = digit * digitBits;
+        auto &histogram = histograms[digit];
+        if (histogram[(entries.front().key >> shift) & (radix - 1)] == count) {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (auto &bucket: histogram) {
+            const uint32_t bucketSize = bucket;
+            bucket = offset;
+            offset += bucketSize;
+        }
+        for (const auto &entry: entries) {
+            scratch[histogram[(entry.key >> shift) & (radix - 1)]++] = entry;
+        }
+        entries.swap(scratch);
+    }
+
+    sorted = true;
+}
+
+void DrawQueue::submit(const vk::raii::CommandBuffer &commandBuffer) {
+    sort();
+
+    statistics = {};
+    statistics.packets = static_cast<uint32_t>(entries.size());
+
+    vk::Pipeline boundPipeline = nullptr;
+    vk::DescriptorSet boundMaterial = nullptr;
+    vk::Buffer boundVertexBuffer = nullptr;
+    vk::DeviceSize boundVertexBufferOffset = 0;
+    vk::Buffer boundIndexBuffer = nullptr;
+    vk::DeviceSize boundIndexBufferOffset = 0;
+    vk::IndexType boundIndexType = vk::IndexType::eUint32;
+
+    for (const auto &entry: entries) {
+        const DrawPacket &packet = packets[entry.packet];
+
+        if (packet.pipeline != boundPipeline) {
+            commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, packet.pipeline);
+            boundPipeline = packet.pipeline;
+            // A new pipeline may come with an incompatible layout, so the material has to be rebound.
+            boundMaterial = nullptr;
+            ++statistics.pipelineBinds;
+        } else {
+            ++statistics.pipelineBindsSaved;
+        }
+
+        if (packet.materialSet) {
+            if (packet.materialSet != boundMaterial) {
+                commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, packet.pipelineLayout, 0,
+                                                 packet.materialSet, nullptr);
+                boundMaterial = packet.materialSet;
+                ++statistics.materialBinds;
+            } else {
+                ++statistics.materialBindsSaved;
+            }
+        }
+
+        if (packet.vertexBuffer) {
+            if (packet.vertexBuffer != boundVertexBuffer || packet.vertexBufferOffset != boundVertexBufferOffset) {
+                commandBuffer.bindVertexBuffers(0, packet.vertexBuffer, packet.vertexBufferOffset);
+                boundVertexBuffer = packet.vertexBuffer;
+                boundVertexBufferOffset = packet.vertexBufferOffset;
+                ++statistics.vertexBufferBinds;
+            } else {
+                ++statistics.vertexBufferBindsSaved;
+            }
+        }
+
+        if (packet.indexBuffer) {
+            if (packet.indexBuffer != boundIndexBuffer || packet.indexBufferOffset != boundIndexBufferOffset ||
+                packet.indexType != boundIndexType) {
+                commandBuffer.bindIndexBuffer(packet.indexBuffer, packet.indexBufferOffset, packet.indexType);
+                boundIndexBuffer = packet.indexBuffer;
+                boundIndexBufferOffset = packet.indexBufferOffset;
+                boundIndexType = packet.indexType;
+                ++statistics.indexBufferBinds;
+            } else {
+                ++statistics.indexBufferBindsSaved;
+            }
+            commandBuffer.drawIndexed(packet.count, packet.instanceCount, packet.first, packet.vertexOffset,
+                                      packet.firstInstance);
+        } else {
+            commandBuffer.draw(packet.count, packet.instanceCount, packet.first, packet.firstInstance);
+        }
+    }
+}
+
+size_t DrawQueue::size() const {
+    return entries.size();
+}
+
+const DrawPacket &DrawQueue::at(const size_t sortedIndex) const {
+    return packets[entries[sortedIndex].packet];
+}
+
+const DrawQueue::Statistics &DrawQueue::getStatistics() const {
+    return statistics;
+}
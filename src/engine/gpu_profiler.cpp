@@ -0,0 +1,95 @@
+#ifndef WW_RELEASE
+
+#include <engine/gpu_profiler.hpp>
+
+void GpuProfiler::init(const vk::raii::Device &device, const vk::raii::PhysicalDevice &physicalDevice,
+                       const uint32_t queueFamilyIndex, const uint32_t maxZonesPerFrame) {
+    const uint32_t validBits = physicalDevice.getQueueFamilyProperties()[queueFamilyIndex].timestampValidBits;
+    if (validBits == 0) {
+        return;
+    }
+
+    timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+    nanosecondsPerTick = physicalDevice.getProperties().limits.timestampPeriod;
+    // One query for the frame anchor plus a begin/end pair per zone.
+    queryCapacity = 1 + maxZonesPerFrame * 2;
+    zones.reserve(maxZonesPerFrame);
+
+    const vk::QueryPoolCreateInfo queryPoolInfo{
+        .queryType = vk::QueryType::eTimestamp,
+        .queryCount = queryCapacity
+    };
+    queryPool = vk::raii::QueryPool(device, queryPoolInfo);
+}
+
+void GpuProfiler::beginFrame(const vk::raii::CommandBuffer &commandBuffer) {
+    if (!isEnabled()) {
+        return;
+    }
+
+    zones.clear();
+    frame = Trace::getFrame();
+    commandBuffer.resetQueryPool(*queryPool, 0, queryCapacity);
+    commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, *queryPool, 0);
+    nextQuery = 1;
+}
+
+void GpuProfiler::markSubmit() {
+    submitTime = Trace::now();
+    pending = isEnabled();
+}
+
+void GpuProfiler::collect() {
+    if (!pending) {
+        return;
+    }
+    pending = false;
+
+    // The caller has waited on the frame's fence, so every written query is available.
+    auto [result, timestamps] = queryPool.getResults<uint64_t>(0, nextQuery, nextQuery * sizeof(uint64_t),
+                                                               sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+    if (result != vk::Result::eSuccess) {
+        return;
+    }
+
+    const uint64_t anchor = timestamps[0] & timestampMask;
+    auto toTrace = [&](const uint64_t timestamp) {
+        const uint64_t ticks = ((timestamp & timestampMask) - anchor) & timestampMask;
+        return submitTime + static_cast<uint64_t>(static_cast<double>(ticks) * nanosecondsPerTick);
+    };
+    for (const auto &[name, beginQuery, endQuery]: zones) {
+        if (endQuery == 0) {
+            continue;
+        }
+        Trace::recordGpuZone(name, toTrace(timestamps[beginQuery]), toTrace(timestamps[endQuery]), frame);
+    }
+}
+
+uint32_t GpuProfiler::beginZone(const vk::raii::CommandBuffer &commandBuffer, const char *name) {
+    if (!isEnabled() || nextQuery + 2 > queryCapacity) {
+        return ~0u;
+    }
+
+    commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, *queryPool, nextQuery);
+    zones.push_back({name, nextQuery, 0});
+    ++nextQuery;
+    // Reserve the end query now so nested zones cannot run the pool dry between begin and end.
+    ++nextQuery;
+    return static_cast<uint32_t>(zones.size() - 1);
+}
+
+void GpuProfiler::endZone(const vk::raii::CommandBuffer &commandBuffer, const uint32_t zone) {
+    if (zone == ~0u) {
+        return;
+    }
+
+    Zone &entry = zones[zone];
+    entry.endQuery = entry.beginQuery + 1;
+    commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, *queryPool, entry.endQuery);
+}
+
+bool GpuProfiler::isEnabled() const {
+    return queryPool != nullptr;
+}
+
+#endif
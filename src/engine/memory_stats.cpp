@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <iostream>
+#include <engine/memory_stats.hpp>
+
+void MemoryStats::init(const vk::raii::PhysicalDevice &physicalDevice, const bool budgetSupported) {
+    this->physicalDevice = &physicalDevice;
+    this->budgetSupported = budgetSupported;
+    memoryProperties = physicalDevice.getMemoryProperties();
+
+    heaps.assign(memoryProperties.memoryHeapCount, {});
+    for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; ++i) {
+        heaps[i].size = memoryProperties.memoryHeaps[i].size;
+        heaps[i].deviceLocal = static_cast<bool>(memoryProperties.memoryHeaps[i].flags &
+                                                 vk::MemoryHeapFlagBits::eDeviceLocal);
+    }
+    update();
+}
+
+void MemoryStats::update() {
+    if (physicalDevice == nullptr) {
+        return;
+    }
+
+    if (budgetSupported) {
+        const auto properties = physicalDevice->getMemoryProperties2<vk::PhysicalDeviceMemoryProperties2,
+            vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+        const auto &budget = properties.get<vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+        for (uint32_t i = 0; i < heaps.size(); ++i) {
+            heaps[i].budget = budget.heapBudget[i];
+            heaps[i].usage = budget.heapUsage[i];
+        }
+    } else {
+        // Without the extension the driver tells us nothing about other processes, so the whole heap is the budget.
+        // The warning threshold provides the headroom below it.
+        for (auto &heap: heaps) {
+            heap.budget = heap.size;
+            heap.usage = heap.trackedUsage;
+        }
+    }
+
+    for (uint32_t i = 0; i < heaps.size(); ++i) {
+        heaps[i].peakUsage = std::max(heaps[i].peakUsage, heaps[i].usage);
+        checkThreshold(i);
+    }
+}
+
+void MemoryStats::recordAllocation(const MemoryCategory category, const uint32_t memoryTypeIndex,
+                                   const vk::DeviceSize size) {
+    recordHeapAllocation(category, memoryProperties.memoryTypes[memoryTypeIndex].heapIndex, size);
+}
+
+void MemoryStats::recordFree(const MemoryCategory category, const uint32_t memoryTypeIndex,
+                             const vk::DeviceSize size) {
+    recordHeapFree(category, memoryProperties.memoryTypes[memoryTypeIndex].heapIndex, size);
+}
+
+void MemoryStats::recordHeapAllocation(const MemoryCategory category, const uint32_t heapIndex,
+                                       const vk::DeviceSize size) {
+    CategoryStats &stats = categories[static_cast<size_t>(category)];
+    stats.current += size;
+    stats.peak = std::max(stats.peak, stats.current);
+    ++stats.allocations;
+
+    // Thresholds are only checked in update(): eviction callbacks must not run while the caller is still in the middle
+    // of setting up what it just allocated.
+    HeapStats &heap = heaps[heapIndex];
+    heap.trackedUsage += size;
+    if (!budgetSupported) {
+        heap.usage = heap.trackedUsage;
+        heap.peakUsage = std::max(heap.peakUsage, heap.usage);
+    }
+}
+
+void MemoryStats::recordHeapFree(const MemoryCategory category, const uint32_t heapIndex,
+                                 const vk::DeviceSize size) {
+    CategoryStats &stats = categories[static_cast<size_t>(category)];
+    stats.current -= std::min(stats.current, size);
+    if (stats.allocations > 0) {
+        --stats.allocations;
+    }
+
+    HeapStats &heap = heaps[heapIndex];
+    heap.trackedUsage -= std::min(heap.trackedUsage, size);
+    if (!budgetSupported) {
+        heap.usage = heap.trackedUsage;
+    }
+}
+
+void MemoryStats::setWarningThreshold(const float fraction) {
+    warningThreshold = std::clamp(fraction, 0.0f, 1.0f);
+}
+
+void MemoryStats::addEvictionCallback(EvictionCallback callback) {
+    evictionCallbacks.push_back(std::move(callback));
+}
+
+bool MemoryStats::isBudgetSupported() const {
+    return budgetSupported;
+}
+
+uint32_t MemoryStats::getDeviceLocalHeap() const {
+    for (uint32_t i = 0; i < heaps.size(); ++i) {
+        if (heaps[i].deviceLocal) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+const std::vector<MemoryStats::HeapStats> &MemoryStats::getHeapStats() const {
+    return heaps;
+}
+
+const MemoryStats::CategoryStats &MemoryStats::getCategoryStats(const MemoryCategory category) const {
+    return categories[static_cast<size_t>(category)];
+}
+
+void MemoryStats::checkThreshold(const uint32_t heapIndex) {
+    HeapStats &heap = heaps[heapIndex];
+    const auto threshold = static_cast<vk::DeviceSize>(static_cast<double>(heap.budget) * warningThreshold);
+    if (heap.budget == 0 || heap.usage <= threshold) {
+        heap.overThreshold = false;
+        return;
+    }
+
+    if (!heap.overThreshold) {
+        std::cerr << "memory: heap " << heapIndex << " usage " << heap.usage / (1024 * 1024) << " MiB is over "
+                << static_cast<int>(warningThreshold * 100.0f) << "% of its " << heap.budget / (1024 * 1024)
+                << " MiB budget" << std::endl;
+        heap.overThreshold = true;
+    }
+    for (const auto &callback: evictionCallbacks) {
+        callback(heapIndex, heap.usage - threshold);
+    }
+}
+
+const char *to_string(const MemoryCategory category) {
+    switch (category) {
+        case MemoryCategory::Buffer: return "buffer";
+        case MemoryCategory::Image: return "image";
+        case MemoryCategory::Staging: return "staging";
+        case MemoryCategory::Swapchain: return "swapchain";
+        case MemoryCategory::Count: break;
+    }
+    return "unknown";
+}
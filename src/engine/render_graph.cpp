@@ -0,0 +1,516 @@
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <engine/render_graph.hpp>
+
+namespace {
+    struct UsageState {
+        vk::ImageLayout layout;
+        vk::PipelineStageFlags2 stages;
+        vk::AccessFlags2 access;
+    };
+
+    UsageState getUsageState(const ResourceUsage usage, const bool write) {
+        switch (usage) {
+            case ResourceUsage::ColorAttachment:
+                return {
+                    vk::ImageLayout::eColorAttachmentOptimal,
+                    vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+                    write
+                        ? vk::AccessFlagBits2::eColorAttachmentRead | vk::AccessFlagBits2::eColorAttachmentWrite
+                        : vk::AccessFlags2(vk::AccessFlagBits2::eColorAttachmentRead)
+                };
+            case ResourceUsage::DepthStencilAttachment:
+                return {
+                    write ? vk::ImageLayout::eDepthStencilAttachmentOptimal : vk::ImageLayout::eDepthStencilReadOnlyOptimal,
+                    vk::PipelineStageFlagBits2::eEarlyFragmentTests | vk::PipelineStageFlagBits2::eLateFragmentTests,
+                    write
+                        ? vk::AccessFlagBits2::eDepthStencilAttachmentRead | vk::AccessFlagBits2::eDepthStencilAttachmentWrite
+                        : vk::AccessFlags2(vk::AccessFlagBits2::eDepthStencilAttachmentRead)
+                };
+            case ResourceUsage::SampledRead:
+                return {
+                    vk::ImageLayout::eShaderReadOnlyOptimal,
+                    vk::PipelineStageFlagBits2::eFragmentShader | vk::PipelineStageFlagBits2::eComputeShader,
+                    vk::AccessFlagBits2::eShaderSampledRead
+                };
+            case ResourceUsage::StorageRead:
+                return {
+                    vk::ImageLayout::eGeneral,
+                    vk::PipelineStageFlagBits2::eFragmentShader | vk::PipelineStageFlagBits2::eComputeShader,
+                    vk::AccessFlagBits2::eShaderStorageRead
+                };
+            case ResourceUsage::StorageWrite:
+                return {
+                    vk::ImageLayout::eGeneral,
+                    vk::PipelineStageFlagBits2::eFragmentShader | vk::PipelineStageFlagBits2::eComputeShader,
+                    vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite
+                };
+            case ResourceUsage::TransferSrc:
+                return {
+                    vk::ImageLayout::eTransferSrcOptimal,
+                    vk::PipelineStageFlagBits2::eTransfer,
+                    vk::AccessFlagBits2::eTransferRead
+                };
+            case ResourceUsage::TransferDst:
+                return {
+                    vk::ImageLayout::eTransferDstOptimal,
+                    vk::PipelineStageFlagBits2::eTransfer,
+                    vk::AccessFlagBits2::eTransferWrite
+                };
+            case ResourceUsage::Present:
+                return {vk::ImageLayout::ePresentSrcKHR, vk::PipelineStageFlagBits2::eBottomOfPipe, {}};
+        }
+        throw std::runtime_error("Unknown resource usage!");
+    }
+
+    vk::ImageUsageFlags getImageUsageFlags(const ResourceUsage usage) {
+        switch (usage) {
+            case ResourceUsage::ColorAttachment: return vk::ImageUsageFlagBits::eColorAttachment;
+            case ResourceUsage::DepthStencilAttachment: return vk::ImageUsageFlagBits::eDepthStencilAttachment;
+            case ResourceUsage::SampledRead: return vk::ImageUsageFlagBits::eSampled;
+            case ResourceUsage::StorageRead:
+            case ResourceUsage::StorageWrite: return vk::ImageUsageFlagBits::eStorage;
+            case ResourceUsage::TransferSrc: return vk::ImageUsageFlagBits::eTransferSrc;
+            case ResourceUsage::TransferDst: return vk::ImageUsageFlagBits::eTransferDst;
+            case ResourceUsage::Present: return {};
+        }
+        return {};
+    }
+
+    // Layout, stages and accesses the image was last left in, as seen by the next barrier.
+    struct TrackedState {
+        vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+        vk::PipelineStageFlags2 stages = vk::PipelineStageFlagBits2::eNone;
+        vk::AccessFlags2 access = {};
+        bool written = false;
+    };
+
+    uint32_t findMemoryType(const vk::raii::PhysicalDevice &physicalDevice, const uint32_t typeBits,
+                            const vk::MemoryPropertyFlags properties) {
+        const auto memoryProperties = physicalDevice.getMemoryProperties();
+        for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i) {
+            if ((typeBits & (1u << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+                return i;
+            }
+        }
+        throw std::runtime_error("Failed to find a suitable memory type for transient images!");
+    }
+}
+
+RenderGraph::PassContext::PassContext(const RenderGraph &graph, const vk::raii::CommandBuffer &commandBuffer)
+    : commandBuffer(commandBuffer), graph(graph) {}
+
+vk::Image RenderGraph::PassContext::getImage(const ResourceHandle handle) const {
+    return graph.resources[handle].image;
+}
+
+vk::ImageView RenderGraph::PassContext::getView(const ResourceHandle handle) const {
+    return graph.resources[handle].view;
+}
+
+const ImageDesc &RenderGraph::PassContext::getDesc(const ResourceHandle handle) const {
+    return graph.resources[handle].desc;
+}
+
+RenderGraph::PassBuilder::PassBuilder(RenderGraph &graph, const uint32_t passIndex)
+    : graph(graph), passIndex(passIndex) {}
+
+void RenderGraph::PassBuilder::read(const ResourceHandle handle, const ResourceUsage usage) {
+    graph.passes[passIndex].accesses.push_back({handle, usage, false});
+}
+
+void RenderGraph::PassBuilder::write(const ResourceHandle handle, const ResourceUsage usage) {
+    graph.passes[passIndex].accesses.push_back({handle, usage, true});
+}
+
+void RenderGraph::PassBuilder::setSideEffect() {
+    graph.passes[passIndex].sideEffect = true;
+}
+
+RenderGraph::ResourceHandle RenderGraph::importImage(std::string name, const ImageDesc &desc,
+                                                     const vk::ImageLayout initialLayout,
+                                                     const ResourceUsage finalUsage,
+                                                     const vk::PipelineStageFlags2 initialStages) {
+    Resource resource{.name = std::move(name), .desc = desc};
+    resource.imported = true;
+    resource.initialLayout = initialLayout;
+    resource.initialStages = initialStages;
+    resource.hasFinalUsage = true;
+    resource.finalUsage = finalUsage;
+    resources.push_back(std::move(resource));
+    return static_cast<ResourceHandle>(resources.size() - 1);
+}
+
+RenderGraph::ResourceHandle RenderGraph::createImage(std::string name, const ImageDesc &desc) {
+    resources.push_back({.name = std::move(name), .desc = desc});
+    return static_cast<ResourceHandle>(resources.size() - 1);
+}
+
+void RenderGraph::addPass(std::string name, const SetupCallback &setup, ExecuteCallback execute) {
+    if (compiled) {
+        throw std::runtime_error("Cannot add pass '" + name + "' to an already compiled render graph!");
+    }
+    passes.push_back({.name = std::move(name), .execute = std::move(execute)});
+    PassBuilder builder{*this, static_cast<uint32_t>(passes.size() - 1)};
+    setup(builder);
+}
+
+RenderGraph::~RenderGraph() {
+    if (memoryStats == nullptr) {
+        return;
+    }
+    for (const auto &block: memoryBlocks) {
+        memoryStats->recordFree(MemoryCategory::Image, block.memoryTypeIndex, block.size);
+    }
+}
+
+void RenderGraph::compile(const vk::raii::Device &device, const vk::raii::PhysicalDevice &physicalDevice,
+                          MemoryStats *memoryStats) {
+    if (compiled) {
+        throw std::runtime_error("Render graph is already compiled!");
+    }
+    this->memoryStats = memoryStats;
+    cullPasses();
+    computeLifetimes();
+    allocateTransients(device, physicalDevice);
+    buildBarriers();
+    compiled = true;
+}
+
+void RenderGraph::setImportedImage(const ResourceHandle handle, const vk::Image image, const vk::ImageView view) {
+    Resource &resource = resources[handle];
+    if (!resource.imported) {
+        throw std::runtime_error("Resource '" + resource.name + "' is not an imported image!");
+    }
+    resource.image = image;
+    resource.view = view;
+}
+
+void RenderGraph::execute(const vk::raii::CommandBuffer &commandBuffer) {
+    assert(compiled);
+    assert(std::ranges::all_of(resources, [](const Resource &resource) {
+        return !resource.imported || (resource.image && resource.view);
+    }) && "every imported image has to be bound with setImportedImage() before execute()");
+
+    const PassContext context{*this, commandBuffer};
+    for (uint32_t order = 0; order < executionOrder.size(); ++order) {
+        recordBatch(commandBuffer, passBarriers[order]);
+        passes[executionOrder[order]].execute(context);
+    }
+    recordBatch(commandBuffer, finalBarriers);
+}
+
+const RenderGraph::Statistics &RenderGraph::getStatistics() const {
+    return statistics;
+}
+
+void RenderGraph::cullPasses() {
+    // Walk backwards from the graph outputs: a pass survives if it has side effects or writes something that is
+    // still needed further down. A write without a matching read fully overwrites the image, so earlier writers
+    // only survive if someone in between reads the result.
+    std::vector needed(resources.size(), false);
+    for (uint32_t i = 0; i < resources.size(); ++i) {
+        needed[i] = resources[i].hasFinalUsage;
+    }
+
+    for (auto pass = passes.rbegin(); pass != passes.rend(); ++pass) {
+        bool live = pass->sideEffect;
+        for (const auto &access: pass->accesses) {
+            if (access.write && needed[access.handle]) {
+                live = true;
+            }
+        }
+        pass->culled = !live;
+        if (!live) {
+            continue;
+        }
+        for (const auto &access: pass->accesses) {
+            if (access.write) {
+                needed[access.handle] = false;
+            }
+        }
+        for (const auto &access: pass->accesses) {
+            if (!access.write) {
+                needed[access.handle] = true;
+            }
+        }
+    }
+
+    executionOrder.clear();
+    for (uint32_t i = 0; i < passes.size(); ++i) {
+        if (!passes[i].culled) {
+            executionOrder.push_back(i);
+        }
+    }
+
+    statistics.declaredPasses = static_cast<uint32_t>(passes.size());
+    statistics.culledPasses = static_cast<uint32_t>(passes.size() - executionOrder.size());
+}
+
+void RenderGraph::computeLifetimes() {
+    for (uint32_t order = 0; order < executionOrder.size(); ++order) {
+        for (const auto &access: passes[executionOrder[order]].accesses) {
+            Resource &resource = resources[access.handle];
+            resource.firstPass = std::min(resource.firstPass, order);
+            resource.lastPass = std::max(resource.lastPass, order);
+            resource.usageFlags |= getImageUsageFlags(access.usage);
+        }
+    }
+}
+
+void RenderGraph::allocateTransients(const vk::raii::Device &device, const vk::raii::PhysicalDevice &physicalDevice) {
+    struct Candidate {
+        ResourceHandle handle;
+        vk::MemoryRequirements requirements;
+    };
+    std::vector<Candidate> candidates;
+
+    for (ResourceHandle handle = 0; handle < resources.size(); ++handle) {
+        Resource &resource = resources[handle];
+        if (resource.imported || resource.firstPass == ~0u) {
+            continue;
+        }
+        const vk::ImageCreateInfo imageInfo{
+            .imageType = vk::ImageType::e2D,
+            .format = resource.desc.format,
+            .extent = {resource.desc.extent.width, resource.desc.extent.height, 1},
+            .mipLevels = 1,
+            .arrayLayers = 1,
+            .samples = vk::SampleCountFlagBits::e1,
+            .tiling = vk::ImageTiling::eOptimal,
+            .usage = resource.usageFlags,
+            .sharingMode = vk::SharingMode::eExclusive,
+            .initialLayout = vk::ImageLayout::eUndefined
+        };
+        resource.ownedImage = vk::raii::Image(device, imageInfo);
+        candidates.push_back({handle, resource.ownedImage.getMemoryRequirements()});
+        statistics.transientBytesRequested += candidates.back().requirements.size;
+    }
+
+    // Largest first, so smaller images fill in behind them instead of growing blocks.
+    std::ranges::sort(candidates, std::greater{}, [](const Candidate &candidate) { return candidate.requirements.size; });
+
+    auto overlaps = [this](const ResourceHandle a, const ResourceHandle b) {
+        return resources[a].firstPass <= resources[b].lastPass && resources[b].firstPass <= resources[a].lastPass;
+    };
+
+    for (const auto &[handle, requirements]: candidates) {
+        MemoryBlock *target = nullptr;
+        for (auto &block: memoryBlocks) {
+            if ((block.memoryTypeBits & requirements.memoryTypeBits) == 0) {
+                continue;
+            }
+            if (std::ranges::any_of(block.occupants, [&](const ResourceHandle other) { return overlaps(handle, other); })) {
+                continue;
+            }
+            target = &block;
+            break;
+        }
+        if (target == nullptr) {
+            target = &memoryBlocks.emplace_back();
+        }
+        // Every occupant is bound at offset 0, so the block only needs to satisfy the strictest alignment in size.
+        target->size = std::max(target->size, requirements.size);
+        target->memoryTypeBits &= requirements.memoryTypeBits;
+        target->occupants.push_back(handle);
+    }
+
+    for (auto &block: memoryBlocks) {
+        block.memoryTypeIndex = findMemoryType(physicalDevice, block.memoryTypeBits,
+                                               vk::MemoryPropertyFlagBits::eDeviceLocal);
+        const vk::MemoryAllocateInfo allocateInfo{
+            .allocationSize = block.size,
+            .memoryTypeIndex = block.memoryTypeIndex
+        };
+        block.memory = vk::raii::DeviceMemory(device, allocateInfo);
+        statistics.transientBytesAllocated += block.size;
+        if (memoryStats != nullptr) {
+            memoryStats->recordAllocation(MemoryCategory::Image, block.memoryTypeIndex, block.size);
+        }
+
+        std::ranges::sort(block.occupants, {}, [this](const ResourceHandle handle) {
+            return resources[handle].firstPass;
+        });
+        for (const auto handle: block.occupants) {
+            Resource &resource = resources[handle];
+            resource.ownedImage.bindMemory(*block.memory, 0);
+
+            const vk::ImageViewCreateInfo viewInfo{
+                .image = *resource.ownedImage,
+                .viewType = vk::ImageViewType::e2D,
+                .format = resource.desc.format,
+                .subresourceRange = {resource.desc.aspect, 0, 1, 0, 1}
+            };
+            resource.ownedView = vk::raii::ImageView(device, viewInfo);
+            resource.image = *resource.ownedImage;
+            resource.view = *resource.ownedView;
+        }
+    }
+
+    statistics.transientImages = static_cast<uint32_t>(candidates.size());
+    statistics.memoryBlocks = static_cast<uint32_t>(memoryBlocks.size());
+}
+
+void RenderGraph::buildBarriers() {
+    std::vector<TrackedState> states(resources.size());
+    for (uint32_t i = 0; i < resources.size(); ++i) {
+        states[i].layout = resources[i].initialLayout;
+        states[i].stages = resources[i].initialStages;
+    }
+
+    auto transition = [&](BarrierBatch &batch, const ResourceHandle handle, const UsageState &target,
+                          const bool write) {
+        TrackedState &state = states[handle];
+        const bool layoutChange = state.layout != target.layout;
+        if (!layoutChange && !state.written && !write) {
+            // Read after read in the same layout: no barrier, but later writers must wait for every reader.
+            state.stages |= target.stages;
+            state.access |= target.access;
+            return;
+        }
+
+        const Resource &resource = resources[handle];
+        batch.barriers.push_back({
+            handle,
+            vk::ImageMemoryBarrier2{
+                .srcStageMask = state.stages,
+                .srcAccessMask = state.written ? state.access : vk::AccessFlags2{},
+                .dstStageMask = target.stages,
+                .dstAccessMask = target.access,
+                .oldLayout = state.layout,
+                .newLayout = target.layout,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .subresourceRange = {
+                    .aspectMask = resource.desc.aspect,
+                    .baseMipLevel = 0,
+                    .levelCount = 1,
+                    .baseArrayLayer = 0,
+                    .layerCount = 1
+                }
+            }
+        });
+        state = {target.layout, target.stages, target.access, write};
+    };
+
+    passBarriers.assign(executionOrder.size(), {});
+    for (uint32_t order = 0; order < executionOrder.size(); ++order) {
+        const Pass &pass = passes[executionOrder[order]];
+
+        // Fold every access of the same image in this pass into one target state first, so a pass that both reads
+        // and writes an image produces a single barrier. Reads and writes with the same usage are merged before
+        // resolving the state, so e.g. a depth-tested pass that also writes depth ends up in the attachment layout
+        // rather than clashing with the read-only one.
+        std::vector<Access> accesses;
+        for (const auto &access: pass.accesses) {
+            const auto it = std::ranges::find_if(accesses, [&](const Access &other) {
+                return other.handle == access.handle && other.usage == access.usage;
+            });
+            if (it == accesses.end()) {
+                accesses.push_back(access);
+            } else {
+                it->write = it->write || access.write;
+            }
+        }
+
+        struct Target {
+            ResourceHandle handle;
+            UsageState state;
+            bool write;
+        };
+        std::vector<Target> targets;
+        for (const auto &access: accesses) {
+            const UsageState usageState = getUsageState(access.usage, access.write);
+            const auto it = std::ranges::find(targets, access.handle, &Target::handle);
+            if (it == targets.end()) {
+                targets.push_back({access.handle, usageState, access.write});
+                continue;
+            }
+            auto &[handle, merged, mergedWrite] = *it;
+            if (merged.layout != usageState.layout) {
+                throw std::runtime_error("Pass '" + pass.name + "' uses '" + resources[access.handle].name +
+                                         "' in two incompatible layouts!");
+            }
+            merged.stages |= usageState.stages;
+            merged.access |= usageState.access;
+            mergedWrite = mergedWrite || access.write;
+        }
+
+        for (const auto &[handle, target, write]: targets) {
+            const Resource &resource = resources[handle];
+            if (!resource.imported && resource.firstPass == order) {
+                if (!write) {
+                    throw std::runtime_error("Pass '" + pass.name + "' reads transient image '" + resource.name +
+                                             "' before any pass has written it!");
+                }
+                // First use of a transient: its previous contents are garbage. Waiting on whatever used its memory
+                // before is added below, once the whole frame is known.
+                states[handle] = {};
+            }
+            transition(passBarriers[order], handle, target, write);
+        }
+    }
+
+    // The first use of a transient has to wait on the previous occupant of its memory: the one before it in the
+    // frame or, for a block's first occupant, the block's last occupant in the previous frame, which queue submission
+    // order brings into the barrier's scope. The image barrier only covers the new image, so the previous occupant's
+    // accesses are made available through a memory barrier in the same batch.
+    for (const auto &block: memoryBlocks) {
+        for (size_t i = 0; i < block.occupants.size(); ++i) {
+            const ResourceHandle handle = block.occupants[i];
+            const TrackedState &previous = states[block.occupants[(i + block.occupants.size() - 1) %
+                                                                 block.occupants.size()]];
+            BarrierBatch &batch = passBarriers[resources[handle].firstPass];
+            vk::ImageMemoryBarrier2 &barrier = std::ranges::find(batch.barriers, handle,
+                                                                 &BarrierTemplate::handle)->barrier;
+            barrier.srcStageMask = previous.stages;
+            if (previous.written) {
+                batch.memoryBarriers.push_back({
+                    .srcStageMask = previous.stages,
+                    .srcAccessMask = previous.access,
+                    .dstStageMask = barrier.dstStageMask,
+                    .dstAccessMask = barrier.dstAccessMask
+                });
+            }
+        }
+    }
+
+    finalBarriers = {};
+    for (ResourceHandle handle = 0; handle < resources.size(); ++handle) {
+        if (resources[handle].hasFinalUsage) {
+            transition(finalBarriers, handle, getUsageState(resources[handle].finalUsage, false), false);
+        }
+    }
+
+    statistics.imageBarriers = 0;
+    statistics.memoryBarriers = 0;
+    statistics.barrierBatches = 0;
+    for (const auto &batch: passBarriers) {
+        statistics.imageBarriers += static_cast<uint32_t>(batch.barriers.size());
+        statistics.memoryBarriers += static_cast<uint32_t>(batch.memoryBarriers.size());
+        statistics.barrierBatches += batch.barriers.empty() && batch.memoryBarriers.empty() ? 0 : 1;
+    }
+    statistics.imageBarriers += static_cast<uint32_t>(finalBarriers.barriers.size());
+    statistics.barrierBatches += finalBarriers.barriers.empty() ? 0 : 1;
+}
+
+void RenderGraph::recordBatch(const vk::raii::CommandBuffer &commandBuffer, const BarrierBatch &batch) {
+    if (batch.barriers.empty() && batch.memoryBarriers.empty()) {
+        return;
+    }
+
+    scratchBarriers.clear();
+    for (const auto &[handle, barrier]: batch.barriers) {
+        scratchBarriers.push_back(barrier);
+        scratchBarriers.back().image = resources[handle].image;
+    }
+    const vk::DependencyInfo dependencyInfo = {
+        .dependencyFlags = {},
+        .memoryBarrierCount = static_cast<uint32_t>(batch.memoryBarriers.size()),
+        .pMemoryBarriers = batch.memoryBarriers.data(),
+        .imageMemoryBarrierCount = static_cast<uint32_t>(scratchBarriers.size()),
+        .pImageMemoryBarriers = scratchBarriers.data()
+    };
+    commandBuffer.pipelineBarrier2(dependencyInfo);
+}
@@ -0,0 +1,195 @@
+#ifndef WW_RELEASE
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <engine/trace.hpp>
+
+namespace {
+    struct Event {
+        const char *name;
+        uint64_t start;
+        uint64_t end;
+        uint32_t frame;
+    };
+
+    struct ThreadBuffer {
+        // Touched only by the owning thread, without a lock. Holds the zones of a single frame until they are
+        // handed over to events.
+        std::vector<Event> pending;
+        uint32_t pendingFrame = 0;
+
+        // Handed-over zones, shared with trimming and exporting.
+        std::mutex mutex;
+        std::vector<Event> events;
+        uint32_t threadId = 0;
+        std::string name;
+    };
+
+    struct Registry {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<ThreadBuffer> > threads;
+        ThreadBuffer gpu;
+        std::atomic<uint32_t> frame{0};
+        const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+        Registry() {
+            gpu.name = "GPU";
+        }
+    };
+
+    Registry &getRegistry() {
+        static Registry registry;
+        return registry;
+    }
+
+    void handOver(ThreadBuffer &buffer);
+
+    // Hands the zones of the current frame over when its thread exits, since it will not record another frame.
+    struct ThreadBufferOwner {
+        ThreadBuffer *buffer;
+
+        ~ThreadBufferOwner() {
+            handOver(*buffer);
+        }
+    };
+
+    ThreadBuffer &getThreadBuffer() {
+        // Buffers are owned by the registry, so zones of threads that have exited can still be exported.
+        thread_local const ThreadBufferOwner owner{[] {
+            Registry &registry = getRegistry();
+            const std::lock_guard lock{registry.mutex};
+            auto &created = registry.threads.emplace_back(std::make_unique<ThreadBuffer>());
+            created->threadId = static_cast<uint32_t>(registry.threads.size());
+            created->name = "Thread " + std::to_string(created->threadId);
+            return created.get();
+        }()};
+        return *owner.buffer;
+    }
+
+    // Must only be called by the thread owning the buffer.
+    void handOver(ThreadBuffer &buffer) {
+        if (buffer.pending.empty()) {
+            return;
+        }
+        const std::lock_guard lock{buffer.mutex};
+        buffer.events.insert(buffer.events.end(), buffer.pending.begin(), buffer.pending.end());
+        buffer.pending.clear();
+    }
+
+    void trim(ThreadBuffer &buffer, const uint32_t oldestFrame) {
+        const std::lock_guard lock{buffer.mutex};
+        std::erase_if(buffer.events, [oldestFrame](const Event &event) { return event.frame < oldestFrame; });
+    }
+
+    void writeEscaped(std::ofstream &file, const std::string_view text) {
+        for (const char c: text) {
+            if (c == '"' || c == '\\') {
+                file << '\\';
+            }
+            file << c;
+        }
+    }
+
+    void writeThread(std::ofstream &file, ThreadBuffer &buffer, const uint32_t firstFrame, const uint32_t lastFrame,
+                     bool &first) {
+        const std::lock_guard lock{buffer.mutex};
+
+        file << (first ? "\n" : ",\n");
+        first = false;
+        file << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << buffer.threadId << R"(,"args":{"name":")";
+        writeEscaped(file, buffer.name);
+        file << "\"}}";
+
+        for (const auto &event: buffer.events) {
+            if (event.frame < firstFrame || event.frame > lastFrame) {
+                continue;
+            }
+            file << ",\n" << R"({"name":")";
+            writeEscaped(file, event.name);
+            file << R"(","ph":"X","pid":1,"tid":)" << buffer.threadId
+                    << R"(,"ts":)" << static_cast<double>(event.start) / 1000.0
+                    << R"(,"dur":)" << static_cast<double>(event.end - event.start) / 1000.0
+                    << R"(,"args":{"frame":)" << event.frame << "}}";
+        }
+    }
+}
+
+uint64_t Trace::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - getRegistry().epoch).count();
+}
+
+uint32_t Trace::getFrame() {
+    return getRegistry().frame.load(std::memory_order_relaxed);
+}
+
+void Trace::markFrame() {
+    handOver(getThreadBuffer());
+
+    Registry &registry = getRegistry();
+    const uint32_t frame = registry.frame.fetch_add(1, std::memory_order_relaxed) + 1;
+
+    // Trimming walks every buffer, so only do it every so often rather than each frame.
+    if (frame % 64 != 0 || frame < retainedFrames) {
+        return;
+    }
+    const uint32_t oldestFrame = frame - retainedFrames;
+    const std::lock_guard lock{registry.mutex};
+    for (const auto &buffer: registry.threads) {
+        trim(*buffer, oldestFrame);
+    }
+    trim(registry.gpu, oldestFrame);
+}
+
+void Trace::setThreadName(std::string name) {
+    ThreadBuffer &buffer = getThreadBuffer();
+    const std::lock_guard lock{buffer.mutex};
+    buffer.name = std::move(name);
+}
+
+void Trace::recordCpuZone(const char *name, const uint64_t startNs, const uint64_t endNs) {
+    ThreadBuffer &buffer = getThreadBuffer();
+    const uint32_t frame = getFrame();
+    if (frame != buffer.pendingFrame) {
+        handOver(buffer);
+        buffer.pendingFrame = frame;
+    }
+    buffer.pending.push_back({name, startNs, endNs, frame});
+}
+
+void Trace::recordGpuZone(const char *name, const uint64_t startNs, const uint64_t endNs, const uint32_t frame) {
+    // GPU zones are collected in one go per frame by a single thread, so taking the lock here is not a hot path.
+    ThreadBuffer &buffer = getRegistry().gpu;
+    const std::lock_guard lock{buffer.mutex};
+    buffer.events.push_back({name, startNs, endNs, frame});
+}
+
+bool Trace::exportChromeTrace(const std::string &path, const uint32_t firstFrame, const uint32_t lastFrame) {
+    handOver(getThreadBuffer());
+
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+    file.setf(std::ios::fixed);
+    file.precision(3);
+
+    Registry &registry = getRegistry();
+    const std::lock_guard lock{registry.mutex};
+
+    bool first = true;
+    file << R"({"displayTimeUnit":"ms","traceEvents":[)";
+    writeThread(file, registry.gpu, firstFrame, lastFrame, first);
+    for (const auto &buffer: registry.threads) {
+        writeThread(file, *buffer, firstFrame, lastFrame, first);
+    }
+    file << "\n]}\n";
+    return file.good();
+}
+
+#endif
@@ -1,9 +1,15 @@
 ﻿#include "game.hpp"
 
-#include <fstream>
+#include <array>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
 
+#include <vulkan/vulkan_format_traits.hpp>
+
 #include "engine/window_glfw.hpp"
+#include "shaders/shader_spv.hpp"
 
 static VKAPI_ATTR vk::Bool32 VKAPI_CALL debugCallback(
     const vk::DebugUtilsMessageSeverityFlagBitsEXT severity,
@@ -21,35 +27,89 @@ Game::Game() {
     constexpr Vec2i windowSize{600, 500};
     window = std::make_unique<WindowGLFW>(windowSize, "Vulkan Setup!");
     initVulkan();
+
+#ifndef WW_RELEASE
+    // WW_TRACE_FRAMES=first-last exports those frames as Chrome trace JSON once the last one has finished
+    if (const char *traceFrames = std::getenv("WW_TRACE_FRAMES")) {
+        if (std::sscanf(traceFrames, "%u-%u", &traceFirstFrame, &traceLastFrame) != 2 ||
+            traceLastFrame < traceFirstFrame) {
+            std::cerr << "Ignoring malformed WW_TRACE_FRAMES, expected first-last" << std::endl;
+        } else if (traceLastFrame - traceFirstFrame >= Trace::retainedFrames) {
+            // Older frames are trimmed while recording, so a wider range would silently lose its start
+            std::cerr << "Ignoring WW_TRACE_FRAMES, at most " << Trace::retainedFrames
+                    << " frames can be exported at once" << std::endl;
+        } else {
+            traceRequested = true;
+        }
+    }
+#endif
 }
 
 Game::~Game() = default;
 
 void Game::start() {
+    WW_TRACE_THREAD_NAME("Main");
+
     window->init([this]() {
-        queue.waitIdle();
-
-       auto [result, imageIndex] = swapChain.acquireNextImage( UINT64_MAX, *presentCompleteSemaphore, nullptr );
-       recordCommandBuffer(imageIndex);
-
-       device.resetFences(  *drawFence );
-       vk::PipelineStageFlags waitDestinationStageMask( vk::PipelineStageFlagBits::eColorAttachmentOutput );
-       const vk::SubmitInfo submitInfo{ .waitSemaphoreCount = 1, .pWaitSemaphores = &*presentCompleteSemaphore,
-                           .pWaitDstStageMask = &waitDestinationStageMask, .commandBufferCount = 1, .pCommandBuffers = &*commandBuffer,
-                           .signalSemaphoreCount = 1, .pSignalSemaphores = &*renderFinishedSemaphore };
-       queue.submit(submitInfo, *drawFence);
-       while ( vk::Result::eTimeout == device.waitForFences( *drawFence, vk::True, UINT64_MAX ) )
-           ;
-
-       const vk::PresentInfoKHR presentInfoKHR{ .waitSemaphoreCount = 1, .pWaitSemaphores = &*renderFinishedSemaphore,
-                                               .swapchainCount = 1, .pSwapchains = &*swapChain, .pImageIndices = &imageIndex };
-       result = queue.presentKHR( presentInfoKHR );
-       switch ( result )
+        {
+            WW_TRACE_ZONE("waitIdle");
+            queue.waitIdle();
+        }
+        memoryStats.update();
+
+       uint32_t imageIndex;
        {
-           case vk::Result::eSuccess: break;
-           case vk::Result::eSuboptimalKHR: std::cout << "vk::Queue::presentKHR returned vk::Result::eSuboptimalKHR !\n"; break;
-           default: break;  // an unexpected result is returned!
+           WW_TRACE_ZONE("acquire");
+           auto [result, acquiredIndex] = swapChain.acquireNextImage( UINT64_MAX, *presentCompleteSemaphore, nullptr );
+           imageIndex = acquiredIndex;
        }
+       {
+           WW_TRACE_ZONE("record");
+           recordCommandBuffer(imageIndex);
+       }
+
+       {
+           WW_TRACE_ZONE("submit");
+           device.resetFences(  *drawFence );
+           vk::PipelineStageFlags waitDestinationStageMask( vk::PipelineStageFlagBits::eColorAttachmentOutput );
+           const vk::SubmitInfo submitInfo{ .waitSemaphoreCount = 1, .pWaitSemaphores = &*presentCompleteSemaphore,
+                               .pWaitDstStageMask = &waitDestinationStageMask, .commandBufferCount = 1, .pCommandBuffers = &*commandBuffer,
+                               .signalSemaphoreCount = 1, .pSignalSemaphores = &*renderFinishedSemaphore };
+#ifndef WW_RELEASE
+           gpuProfiler.markSubmit();
+#endif
+           queue.submit(submitInfo, *drawFence);
+       }
+       {
+           WW_TRACE_ZONE("fenceWait");
+           while ( vk::Result::eTimeout == device.waitForFences( *drawFence, vk::True, UINT64_MAX ) )
+               ;
+       }
+#ifndef WW_RELEASE
+       gpuProfiler.collect();
+#endif
+
+       {
+           WW_TRACE_ZONE("present");
+           const vk::PresentInfoKHR presentInfoKHR{ .waitSemaphoreCount = 1, .pWaitSemaphores = &*renderFinishedSemaphore,
+                                                   .swapchainCount = 1, .pSwapchains = &*swapChain, .pImageIndices = &imageIndex };
+           const auto result = queue.presentKHR( presentInfoKHR );
+           switch ( result )
+           {
+               case vk::Result::eSuccess: break;
+               case vk::Result::eSuboptimalKHR: std::cout << "vk::Queue::presentKHR returned vk::Result::eSuboptimalKHR !\n"; break;
+               default: break;  // an unexpected result is returned!
+           }
+       }
+
+       WW_TRACE_FRAME_MARK();
+#ifndef WW_RELEASE
+       if (traceRequested && Trace::getFrame() == traceLastFrame + 1) {
+           if (Trace::exportChromeTrace("trace.json", traceFirstFrame, traceLastFrame)) {
+               std::cout << "Wrote frames " << traceFirstFrame << "-" << traceLastFrame << " to trace.json\n";
+           }
+       }
+#endif
     });
 }
 
@@ -64,6 +124,10 @@ void Game::initVulkan() {
     createGraphicsPipeline();
     createCommandPool();
     createCommandBuffer();
+#ifndef WW_RELEASE
+    gpuProfiler.init(device, physicalDevice, queueIndex);
+#endif
+    createRenderGraph();
     createSyncObjects();
 }
 
@@ -220,6 +284,15 @@ void Game::createLogicalDevice() {
                 {.extendedDynamicState = true} // vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT
             };
 
+    // VK_EXT_memory_budget is optional, without it MemoryStats falls back to heap sizes
+    for (const auto &extension: physicalDevice.enumerateDeviceExtensionProperties()) {
+        if (strcmp(extension.extensionName, vk::EXTMemoryBudgetExtensionName) == 0) {
+            memoryBudgetSupported = true;
+            deviceExtensions.push_back(vk::EXTMemoryBudgetExtensionName);
+            break;
+        }
+    }
+
     // create a Device
     float queuePriority = 0.0f;
     vk::DeviceQueueCreateInfo deviceQueueCreateInfo{
@@ -235,6 +308,8 @@ void Game::createLogicalDevice() {
 
     device = vk::raii::Device(physicalDevice, deviceCreateInfo);
     queue = vk::raii::Queue(device, queueIndex, 0);
+
+    memoryStats.init(physicalDevice, memoryBudgetSupported);
 }
 
 void Game::createSwapChain() {
@@ -258,6 +333,11 @@ void Game::createSwapChain() {
 
     swapChain = vk::raii::SwapchainKHR(device, swapChainCreateInfo);
     swapChainImages = swapChain.getImages();
+
+    // Swapchain images are allocated by the driver, so their size can only be estimated from extent and format
+    memoryStats.recordHeapAllocation(MemoryCategory::Swapchain, memoryStats.getDeviceLocalHeap(),
+                                     static_cast<vk::DeviceSize>(swapChainExtent.width) * swapChainExtent.height *
+                                     vk::blockSize(swapChainSurfaceFormat.format) * swapChainImages.size());
 }
 
 void Game::createImageViews() {
@@ -274,13 +354,28 @@ void Game::createImageViews() {
 }
 
 void Game::createGraphicsPipeline() {
-    vk::raii::ShaderModule shaderModule = createShaderModule(readFile("assets/shaders/shader.spv"));
+    // SPIR-V is compiled, optimized and embedded at build time (see embed_slang_shader in CMakeLists.txt)
+    vk::raii::ShaderModule shaderModule = createShaderModule(shaderSpirv);
+
+    const std::array specializationEntries = {
+        vk::SpecializationMapEntry{
+            .constantID = 0, .offset = offsetof(ShaderFeatures, useVertexColours), .size = sizeof(vk::Bool32)
+        },
+    };
+    const vk::SpecializationInfo specializationInfo{
+        .mapEntryCount = static_cast<uint32_t>(specializationEntries.size()),
+        .pMapEntries = specializationEntries.data(),
+        .dataSize = sizeof(ShaderFeatures),
+        .pData = &shaderFeatures
+    };
 
     vk::PipelineShaderStageCreateInfo vertShaderStageInfo{
-        .stage = vk::ShaderStageFlagBits::eVertex, .module = shaderModule, .pName = "vertMain"
+        .stage = vk::ShaderStageFlagBits::eVertex, .module = shaderModule, .pName = "vertMain",
+        .pSpecializationInfo = &specializationInfo
     };
     vk::PipelineShaderStageCreateInfo fragShaderStageInfo{
-        .stage = vk::ShaderStageFlagBits::eFragment, .module = shaderModule, .pName = "fragMain"
+        .stage = vk::ShaderStageFlagBits::eFragment, .module = shaderModule, .pName = "fragMain",
+        .pSpecializationInfo = &specializationInfo
     };
     vk::PipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
 
@@ -353,86 +448,68 @@ void Game::createCommandBuffer() {
     commandBuffer = std::move(vk::raii::CommandBuffers(device, allocInfo).front());
 }
 
-void Game::recordCommandBuffer(const uint32_t imageIndex) {
-    commandBuffer.begin({});
-    // Before starting rendering, transition the swapchain image to COLOR_ATTACHMENT_OPTIMAL
-    transition_image_layout(
-        imageIndex,
+void Game::createRenderGraph() {
+    // The swapchain image is discarded on acquire; its first barrier waits on the acquire semaphore's wait stage.
+    backBuffer = renderGraph.importImage(
+        "backBuffer",
+        {.format = swapChainSurfaceFormat.format, .extent = swapChainExtent},
         vk::ImageLayout::eUndefined,
-        vk::ImageLayout::eColorAttachmentOptimal,
-        {}, // srcAccessMask (no need to wait for previous operations)
-        vk::AccessFlagBits2::eColorAttachmentWrite, // dstAccessMask
-        vk::PipelineStageFlagBits2::eTopOfPipe, // srcStage
-        vk::PipelineStageFlagBits2::eColorAttachmentOutput // dstStage
+        ResourceUsage::Present,
+        vk::PipelineStageFlagBits2::eColorAttachmentOutput
     );
-    constexpr vk::ClearValue clearColor = vk::ClearColorValue(0.0f, 0.0f, 0.0f, 1.0f);
-    vk::RenderingAttachmentInfo attachmentInfo = {
-        .imageView = swapChainImageViews[imageIndex],
-        .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
-        .loadOp = vk::AttachmentLoadOp::eClear,
-        .storeOp = vk::AttachmentStoreOp::eStore,
-        .clearValue = clearColor
-    };
-    const vk::RenderingInfo renderingInfo = {
-        .renderArea = {.offset = {0, 0}, .extent = swapChainExtent},
-        .layerCount = 1,
-        .colorAttachmentCount = 1,
-        .pColorAttachments = &attachmentInfo
-    };
 
-    commandBuffer.beginRendering(renderingInfo);
-    commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, *graphicsPipeline);
-    commandBuffer.setViewport(0, vk::Viewport(0.0f, 0.0f, static_cast<float>(swapChainExtent.width),
-                                              static_cast<float>(swapChainExtent.height), 0.0f, 1.0f));
-    commandBuffer.setScissor(0, vk::Rect2D(vk::Offset2D(0, 0), swapChainExtent));
-    commandBuffer.draw(3, 1, 0, 0);
-    commandBuffer.endRendering();
-    // After rendering, transition the swapchain image to PRESENT_SRC
-    transition_image_layout(
-        imageIndex,
-        vk::ImageLayout::eColorAttachmentOptimal,
-        vk::ImageLayout::ePresentSrcKHR,
-        vk::AccessFlagBits2::eColorAttachmentWrite, // srcAccessMask
-        {}, // dstAccessMask
-        vk::PipelineStageFlagBits2::eColorAttachmentOutput, // srcStage
-        vk::PipelineStageFlagBits2::eBottomOfPipe // dstStage
+    renderGraph.addPass(
+        "triangle",
+        [this](RenderGraph::PassBuilder &builder) {
+            builder.write(backBuffer, ResourceUsage::ColorAttachment);
+        },
+        [this](const RenderGraph::PassContext &context) {
+            WW_TRACE_GPU_ZONE(gpuProfiler, context.commandBuffer, "triangle");
+            constexpr vk::ClearValue clearColor = vk::ClearColorValue(0.0f, 0.0f, 0.0f, 1.0f);
+            vk::RenderingAttachmentInfo attachmentInfo = {
+                .imageView = context.getView(backBuffer),
+                .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
+                .loadOp = vk::AttachmentLoadOp::eClear,
+                .storeOp = vk::AttachmentStoreOp::eStore,
+                .clearValue = clearColor
+            };
+            const vk::RenderingInfo renderingInfo = {
+                .renderArea = {.offset = {0, 0}, .extent = swapChainExtent},
+                .layerCount = 1,
+                .colorAttachmentCount = 1,
+                .pColorAttachments = &attachmentInfo
+            };
+
+            const auto &cmd = context.commandBuffer;
+            cmd.beginRendering(renderingInfo);
+            cmd.setViewport(0, vk::Viewport(0.0f, 0.0f, static_cast<float>(swapChainExtent.width),
+                                            static_cast<float>(swapChainExtent.height), 0.0f, 1.0f));
+            cmd.setScissor(0, vk::Rect2D(vk::Offset2D(0, 0), swapChainExtent));
+            drawQueue.submit(cmd);
+            cmd.endRendering();
+        }
     );
-    commandBuffer.end();
+
+    renderGraph.compile(device, physicalDevice, &memoryStats);
 }
 
-void Game::transition_image_layout(
-    const uint32_t currentFrame,
-    const vk::ImageLayout old_layout,
-    const vk::ImageLayout new_layout,
-    const vk::AccessFlags2 src_access_mask,
-    const vk::AccessFlags2 dst_access_mask,
-    const vk::PipelineStageFlags2 src_stage_mask,
-    const vk::PipelineStageFlags2 dst_stage_mask
-) {
-    vk::ImageMemoryBarrier2 barrier = {
-        .srcStageMask = src_stage_mask,
-        .srcAccessMask = src_access_mask,
-        .dstStageMask = dst_stage_mask,
-        .dstAccessMask = dst_access_mask,
-        .oldLayout = old_layout,
-        .newLayout = new_layout,
-        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .image = swapChainImages[currentFrame],
-        .subresourceRange = {
-            .aspectMask = vk::ImageAspectFlagBits::eColor,
-            .baseMipLevel = 0,
-            .levelCount = 1,
-            .baseArrayLayer = 0,
-            .layerCount = 1
-        }
-    };
-    const vk::DependencyInfo dependency_info = {
-        .dependencyFlags = {},
-        .imageMemoryBarrierCount = 1,
-        .pImageMemoryBarriers = &barrier
-    };
-    commandBuffer.pipelineBarrier2(dependency_info);
+void Game::recordCommandBuffer(const uint32_t imageIndex) {
+    drawQueue.clear();
+    drawQueue.push({
+        .sortKey = SortKey::make(0, 0, 0, SortKey::quantizeDepth(0.0f)),
+        .pipeline = *graphicsPipeline,
+        .pipelineLayout = *pipelineLayout,
+        .count = 3
+    });
+
+    commandBuffer.begin({});
+#ifndef WW_RELEASE
+    gpuProfiler.beginFrame(commandBuffer);
+#endif
+    // Layout transitions and barriers are generated by the render graph from what each pass declares
+    renderGraph.setImportedImage(backBuffer, swapChainImages[imageIndex], *swapChainImageViews[imageIndex]);
+    renderGraph.execute(commandBuffer);
+    commandBuffer.end();
 }
 
 void Game::createSyncObjects() {
@@ -442,9 +519,9 @@ void Game::createSyncObjects() {
 }
 
 
-vk::raii::ShaderModule Game::createShaderModule(const std::vector<char> &code) const {
+vk::raii::ShaderModule Game::createShaderModule(const std::span<const uint32_t> code) const {
     const vk::ShaderModuleCreateInfo createInfo{
-        .codeSize = code.size() * sizeof(char), .pCode = reinterpret_cast<const uint32_t *>(code.data())
+        .codeSize = code.size_bytes(), .pCode = code.data()
     };
     vk::raii::ShaderModule shaderModule{device, createInfo};
 
@@ -492,15 +569,3 @@ vk::Extent2D Game::chooseSwapExtent(const vk::SurfaceCapabilitiesKHR &capabiliti
         std::clamp<uint32_t>(height, capabilities.minImageExtent.height, capabilities.maxImageExtent.height)
     };
 }
-
-std::vector<char> Game::readFile(const std::string &filename) {
-    std::ifstream file(filename, std::ios::ate | std::ios::binary);
-    if (!file.is_open()) {
-        throw std::runtime_error("failed to open file!");
-    }
-    std::vector<char> buffer(file.tellg());
-    file.seekg(0, std::ios::beg);
-    file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
-    file.close();
-    return buffer;
-}
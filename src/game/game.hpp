@@ -1,11 +1,21 @@
 ﻿#pragma once
 
+#include <span>
+
 #include <vulkan/vulkan_raii.hpp>
 
+#include "engine/draw_queue.hpp"
+#include "engine/gpu_profiler.hpp"
+#include "engine/memory_stats.hpp"
+#include "engine/render_graph.hpp"
 #include "engine/window.hpp"
 
 class Game {
 public: // Properties
+    // Values of the specialization constants declared in assets/shaders/shader.slang
+    struct ShaderFeatures {
+        vk::Bool32 useVertexColours = vk::True;
+    };
 
 private: // Member Variables
     std::unique_ptr<Window> window;
@@ -14,6 +24,8 @@ private: // Member Variables
     vk::raii::Instance instance = nullptr;
     vk::raii::PhysicalDevice physicalDevice = nullptr;
     vk::raii::Device device = nullptr;
+    bool memoryBudgetSupported = false;
+    MemoryStats memoryStats;
     uint32_t queueIndex = ~0;
     vk::raii::Queue queue = nullptr;
     vk::raii::SwapchainKHR swapChain = nullptr;
@@ -22,11 +34,23 @@ private: // Member Variables
     vk::Extent2D swapChainExtent;
     std::vector<vk::raii::ImageView> swapChainImageViews;
 
+    ShaderFeatures shaderFeatures;
     vk::raii::PipelineLayout pipelineLayout = nullptr;
     vk::raii::Pipeline graphicsPipeline = nullptr;
     vk::raii::CommandPool commandPool = nullptr;
     vk::raii::CommandBuffer commandBuffer = nullptr;
 
+#ifndef WW_RELEASE
+    GpuProfiler gpuProfiler;
+    bool traceRequested = false;
+    uint32_t traceFirstFrame = 0;
+    uint32_t traceLastFrame = 0;
+#endif
+
+    DrawQueue drawQueue;
+    RenderGraph renderGraph;
+    RenderGraph::ResourceHandle backBuffer = ~0u;
+
     vk::raii::Semaphore presentCompleteSemaphore = nullptr;
     vk::raii::Semaphore renderFinishedSemaphore = nullptr;
     vk::raii::Fence drawFence = nullptr;
@@ -67,18 +91,15 @@ private: // Private Methods
     void createGraphicsPipeline();
     void createCommandPool();
     void createCommandBuffer();
+    void createRenderGraph();
 
     void recordCommandBuffer(uint32_t imageIndex);
-    void transition_image_layout(uint32_t currentFrame, vk::ImageLayout old_layout, vk::ImageLayout new_layout,
-                                 vk::AccessFlags2 src_access_mask, vk::AccessFlags2 dst_access_mask,
-                                 vk::PipelineStageFlags2 src_stage_mask, vk::PipelineStageFlags2 dst_stage_mask);
     void createSyncObjects();
 
 
-    [[nodiscard]] vk::raii::ShaderModule createShaderModule(const std::vector<char> &code) const;
+    [[nodiscard]] vk::raii::ShaderModule createShaderModule(std::span<const uint32_t> code) const;
     uint32_t chooseSwapMinImageCount(vk::SurfaceCapabilitiesKHR const &surfaceCapabilities);
     vk::SurfaceFormatKHR chooseSwapSurfaceFormat(std::vector<vk::SurfaceFormatKHR> const &availableFormats);
     vk::PresentModeKHR chooseSwapPresentMode(const std::vector<vk::PresentModeKHR> &availablePresentModes);
     [[nodiscard]] vk::Extent2D chooseSwapExtent(const vk::SurfaceCapabilitiesKHR &capabilities) const;
-    std::vector<char> readFile(const std::string &filename);
 };